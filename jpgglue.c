@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "third_party/jpeg-7/jpeglib.h"
 #include "third_party/jpeg-7/jerror.h"
@@ -465,6 +466,101 @@ jpeg_memory_dst(struct jpeg_compress_struct *cinfo) {
     cinfo->dest->term_destination = &my_term_destination;
 }
 
+// Destination into a file descriptor stuff
+
+/* Expanded data destination object for file descriptor output */
+
+typedef struct {
+  struct  jpeg_destination_mgr pub; /* public fields */
+
+  int     outfd;                /* target file descriptor */
+  JOCTET  *buffer;              /* start of buffer */
+  int     written;              /* bytes handed to write() so far */
+} my_fd_destination_mgr;
+
+typedef my_fd_destination_mgr   *my_fd_dest_ptr;
+
+#define OUTPUT_BUF_SIZE 65536   /* choose an efficiently write'able size */
+
+/*
+ * Write 'count' bytes of the buffer, retrying short writes.
+ */
+static void
+fd_write_buffer(j_compress_ptr cinfo, size_t count)
+{
+  my_fd_dest_ptr dest = (my_fd_dest_ptr) cinfo->dest;
+  JOCTET         *p = dest->buffer;
+  ssize_t        n;
+
+  while (count > 0) {
+    n = write(dest->outfd, p, count);
+    if (n <= 0)
+      ERREXIT(cinfo, JERR_FILE_WRITE);
+    p += n;
+    count -= (size_t) n;
+    dest->written += (int) n;
+  }
+}
+
+static void my_fd_init_destination(j_compress_ptr cinfo)
+{
+  my_fd_dest_ptr dest = (my_fd_dest_ptr) cinfo->dest;
+
+  /* Allocate the output buffer --- it will be released when done with image */
+  dest->buffer = (JOCTET *)
+      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+                                  OUTPUT_BUF_SIZE * SIZEOF(JOCTET));
+  dest->written = 0;
+  dest->pub.next_output_byte = dest->buffer;
+  dest->pub.free_in_buffer = OUTPUT_BUF_SIZE;
+}
+
+/*
+ * Called whenever the buffer fills up, so the encoded image goes out in
+ * OUTPUT_BUF_SIZE chunks rather than being held in memory until the end.
+ */
+static boolean my_fd_empty_output_buffer(j_compress_ptr cinfo)
+{
+  my_fd_dest_ptr dest = (my_fd_dest_ptr) cinfo->dest;
+
+  fd_write_buffer(cinfo, OUTPUT_BUF_SIZE);
+  dest->pub.next_output_byte = dest->buffer;
+  dest->pub.free_in_buffer = OUTPUT_BUF_SIZE;
+
+  return TRUE;
+}
+
+static void my_fd_term_destination(j_compress_ptr cinfo)
+{
+  my_fd_dest_ptr dest = (my_fd_dest_ptr) cinfo->dest;
+
+  /* Write any data remaining in the buffer */
+  fd_write_buffer(cinfo, OUTPUT_BUF_SIZE - cinfo->dest->free_in_buffer);
+  gIP->ip_ReCompSize = dest->written;
+}
+
+/*
+ * Prepare for output to a file descriptor.
+ * The caller must have already opened it, and is responsible
+ * for closing it after finishing compression.
+ */
+static void
+jpeg_fd_dst(j_compress_ptr cinfo, int outfd) {
+  my_fd_dest_ptr dest;
+
+  if (cinfo->dest == NULL) {        /* first time for this JPEG object? */
+    cinfo->dest = (struct jpeg_destination_mgr *)
+      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+                                  SIZEOF(my_fd_destination_mgr));
+  }
+
+  dest = (my_fd_dest_ptr) cinfo->dest;
+  dest->pub.init_destination = my_fd_init_destination;
+  dest->pub.empty_output_buffer = my_fd_empty_output_buffer;
+  dest->pub.term_destination = my_fd_term_destination;
+  dest->outfd = outfd;
+}
+
 void
 jpeg_compress(IJG_Private *ip, int q) {
   struct jpeg_compress_struct cinfo;
@@ -488,7 +584,10 @@ jpeg_compress(IJG_Private *ip, int q) {
   /* Now that we know input colorspace, fix colorspace-dependent defaults */
   jpeg_default_colorspace(&cinfo);
 
-  jpeg_memory_dst(&cinfo);
+  if (ip->ip_OutFd >= 0)
+    jpeg_fd_dst(&cinfo, ip->ip_OutFd);
+  else
+    jpeg_memory_dst(&cinfo);
 
   /* Start compressor */
   jpeg_start_compress(&cinfo, TRUE);
@@ -28,6 +28,7 @@ typedef struct
     int         ip_Height;
     int         ip_Stride;
     int         ip_ReCompSize;
+    int         ip_OutFd;       /* >= 0 streams compressed output here  */
 } IJG_Private;
 
 void    jpeg_memory_dimensions(void *indata, int len, int *w, int *h);
@@ -37,6 +37,7 @@ jpg_transcode(unsigned char *buffer, int len, int quality) {
     ip.ip_SrcBuf = buffer;
     ip.ip_SrcLen = len;
     ip.ip_DstBuf = out;
+    ip.ip_OutFd = -1;
     ip.ip_CompBuf = malloc(len);
     ip.ip_CompSize = len;
     if (ip.ip_CompBuf == NULL)
@@ -51,3 +52,32 @@ jpg_transcode(unsigned char *buffer, int len, int quality) {
 
     return ip.ip_ReCompSize;
 }
+
+/*
+ * As above, but leaves 'buffer' untouched (so it may be a read-only mapping)
+ * and streams the recompressed image to 'outfd' as it is produced.
+ * Returns the number of bytes written.
+ */
+int
+jpg_transcode_fd(const unsigned char *buffer, int len, int quality, int outfd) {
+    void          *out;
+    IJG_Private   ip;
+
+    // get sizes
+    jpeg_memory_dimensions((void *)buffer, len, &ip.ip_Width, &ip.ip_Height);
+    out = malloc(ip.ip_Width * ip.ip_Height * 4);
+    if (out == NULL)
+      return 0;
+    ip.ip_SrcBuf = (void *)buffer;
+    ip.ip_SrcLen = len;
+    ip.ip_DstBuf = out;
+    ip.ip_CompBuf = NULL;
+    ip.ip_CompSize = 0;
+    ip.ip_OutFd = outfd;
+
+    load_jpeg_data(&ip);
+    jpeg_compress(&ip, quality);
+    free(out);
+
+    return ip.ip_ReCompSize;
+}
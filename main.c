@@ -14,12 +14,15 @@
  * the License.
  */
 /* Test harness for JPG transcode */
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
-extern int      jpg_transcode(void *input, int len, int quality);
+extern int      jpg_transcode_fd(const void *input, int len, int quality, int outfd);
 
 static void
 usage() {
@@ -28,13 +31,39 @@ usage() {
 }
 
 #define IMG         "images/js-wa-900.jpg"
+#define OUT         "out.jpg"
+
+/*
+ * Map a whole file read-only so the decoder reads straight out of the
+ * page cache instead of from a malloc'd copy.
+ */
+static void *
+map_input(const char *path, int *len) {
+    struct stat st;
+    void        *data;
+    int         fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    *len = (int)st.st_size;
+    return data;
+}
 
 int
 main(int argc, char *argv[]) {
-    int          q, len;
+    int          q, len, out;
     void         *src;
-    FILE         *f, *out;
-    struct stat st;
 
     if (argc < 3) {
         usage();
@@ -45,26 +74,18 @@ main(int argc, char *argv[]) {
 
     q = atoi(argv[2]);
 
-    if ((f = fopen(IMG, "rb")) == NULL) {
+    if ((src = map_input(IMG, &len)) == NULL) {
         puts("Barf");
         exit(2);
     }
-    if (stat(IMG, &st) != 0) {
+    out = open(OUT, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
         exit(3);
     }
-    src = malloc(st.st_size);
-    if (src == NULL) {
-        exit(4);
-    }
-    fread(src, st.st_size, 1, f);
-    len = jpg_transcode(src, st.st_size, q);
-    out = fopen("out.jpg", "wb");
-    if (out) {
-        fwrite(src, len, 1, out);
-        fclose(out);
-    }
+    jpg_transcode_fd(src, len, q, out);
 
-    fclose(f);
+    close(out);
+    munmap(src, len);
 
     return 0;
 }